@@ -0,0 +1,167 @@
+#!/bin/bash
+
+# Benchmark the engines on generated terrains and on the test inputs.
+# Terrains are generated by generate.c (random, fractal, maze, plateau) with a fixed seed for every size.
+# Every engine variant (engine, and queue backend for grid) runs once to warm up, then REPS times:
+# the first table prints median and 95th percentile of the search time (ms, from -v), a run over
+# LIMIT seconds (default 60) stops the variant and prints "-".
+# The contraction hierarchy of ch is built by the warm-up run and saved next to the terrain.
+# The second table prints the suboptimality of the approximate hpa on QUERIES random queries of every
+# generated terrain: mean and maximum excess effort (%) over the exact one, for 1, 2 and 4 portals per side.
+# The third table prints the median parse time of the fscanf parser and of the scanner without and with SWAR.
+# The fourth table compares the graph of the graph engine allocated from the arena and with a malloc for every
+# object (-DARENA_MALLOC=1): allocations, MB allocated, median build and free time, peak resident memory.
+# usage: ./bench.sh [repetitions] [terrain sizes, 100 to 10000...]
+
+TESTS_PATH="test/"
+BENCH_PATH="bench/"
+
+MAINFILE="0001114169"
+COMPILE="gcc -std=c90 -Wall -Wpedantic -O2 -pthread ${MAINFILE}.c"
+
+BACKENDS="PQ_BINARY PQ_DARY PQ_PAIRING PQ_RADIX"
+ENGINES="graph bidir grid astar delta sweep tiled ch hpa"
+TERRAINS="random fractal maze plateau"
+SEED=1114169
+QUERIES=32
+LIMIT=${LIMIT:-60}
+
+REPS=${1:-5}
+shift
+SIZES=${@:-100 500 1000}
+
+mkdir -p ${BENCH_PATH}
+
+# build one binary per backend, the SWAR parser and the generator
+for backend in $BACKENDS; do
+  eval "${COMPILE} -DPQ_BACKEND=${backend} -o ${BENCH_PATH}${MAINFILE}_${backend}" || exit 1
+done
+eval "${COMPILE} -DPARSE_SWAR=1 -o ${BENCH_PATH}${MAINFILE}_swar" || exit 1
+eval "${COMPILE} -DARENA_MALLOC=1 -o ${BENCH_PATH}${MAINFILE}_malloc" || exit 1
+gcc -std=c90 -Wall -Wpedantic -O2 generate.c -o ${BENCH_PATH}generate || exit 1
+
+# binary terrains: the tests converted, then `size` x `size` generated terrains
+INPUTS=""
+for input in ${TESTS_PATH}*.in; do
+  terrain="${BENCH_PATH}$(basename $input .in).bin"
+  [ -f "$terrain" ] || ./${BENCH_PATH}${MAINFILE}_PQ_BINARY -c "$terrain" "$input" || exit 1
+  INPUTS="$INPUTS $terrain"
+done
+for size in $SIZES; do
+  for kind in $TERRAINS; do
+    terrain="${BENCH_PATH}${kind}${size}.bin"
+    [ -f "$terrain" ] || ./${BENCH_PATH}generate $kind $size $size $SEED "$terrain" || exit 1
+    INPUTS="$INPUTS $terrain"
+  done
+done
+
+# print median and 95th percentile (nearest rank) of the times on stdin, "-" if there are none
+summary() {
+  sort -n | awk '{ t[NR] = $1 }
+    END {
+      if (NR == 0) { printf " %10s %10s", "-", "-"; exit }
+      p = int(NR * 0.95); if (p < NR * 0.95) p++
+      printf " %10.3f %10.3f", t[int((NR + 1) / 2)], t[p]
+    }'
+}
+
+# print the search ms of a warm-up run and REPS runs of the command, nothing after a run over LIMIT
+search_times() {
+  timeout $LIMIT "$@" >/dev/null 2>&1 || return
+  for i in $(seq $REPS); do
+    out=$(timeout $LIMIT "$@" 2>&1 >/dev/null) || return
+    echo "$out" | awk '/search ms/ { print $3 }'
+  done
+}
+
+printf "%-20s %-18s %10s %10s\n" "input" "engine" "median" "p95"
+for input in $INPUTS; do
+  # the graph engines (graph, bidir) are used up to MAX_DIMENSION, larger inputs switch to grid
+  n=$(od -An -t d4 -j 16 -N 4 "$input" | tr -d ' ')
+  for engine in $ENGINES; do
+    backends="PQ_BINARY"
+    [ "$engine" = "grid" ] && backends=$BACKENDS
+    extra=""
+    [ "$engine" = "ch" ] && extra="-k ${BENCH_PATH}$(basename $input .bin).ch"
+    for backend in $backends; do
+      printf "%-20s %-18s" "$(basename $input)" "$engine $backend"
+      if { [ "$engine" = "graph" ] || [ "$engine" = "bidir" ]; } && [ "$n" -gt 250 ]; then
+        echo -n "" | summary
+      else
+        search_times ./${BENCH_PATH}${MAINFILE}_${backend} -v -e $engine $extra $input 2>/dev/null | summary
+      fi
+      printf "\n"
+    done
+  done
+done
+
+# efforts of the paths printed by the command
+efforts() {
+  timeout $LIMIT "$@" 2>/dev/null | awk 'effort { print; effort = 0 } /^-1 -1$/ { effort = 1 }'
+}
+
+# generated terrains with random queries appended, answered exactly by grid and approximately by hpa
+printf "\n%-20s %20s %20s %20s\n" "input" "hpa 1 mean/max %" "hpa 2 mean/max %" "hpa 4 mean/max %"
+for size in $SIZES; do
+  for kind in $TERRAINS; do
+    queried="${BENCH_PATH}${kind}${size}_queries.bin"
+    if [ ! -f "$queried" ]; then
+      cp "${BENCH_PATH}${kind}${size}.bin" "$queried"
+      awk -v n=$size -v q=$QUERIES -v seed=$SEED 'BEGIN {
+        srand(seed); print q
+        for (i = 0; i < q; i++) print int(rand() * n), int(rand() * n), int(rand() * n), int(rand() * n)
+      }' >> "$queried"
+    fi
+    efforts ./${BENCH_PATH}${MAINFILE}_PQ_BINARY -b -e grid "$queried" > ${BENCH_PATH}exact.txt
+    printf "%-20s" "${kind}${size}.bin"
+    for portals in 1 2 4; do
+      efforts ./${BENCH_PATH}${MAINFILE}_PQ_BINARY -b -e hpa -g 32 $portals "$queried" |
+        paste ${BENCH_PATH}exact.txt - |
+        awk '$2 != "" { r = 100 * ($2 / $1 - 1); s += r; c++; if (r > mx) mx = r }
+          END { if (c == 0) printf " %20s", "-"; else printf " %9.2f/%-10.2f", s / c, mx }'
+    done
+    printf "\n"
+  done
+done
+
+# median of the `field` ms printed by -v over REPS runs of the command
+median() {
+  field=$1
+  shift
+  for i in $(seq $REPS); do
+    "$@" 2>&1 >/dev/null | awk -v f="$field" '$0 ~ f { print $3 }'
+  done | sort -n | awk '{ t[NR] = $1 } END { printf " %12.3f", t[int((NR + 1) / 2)] }'
+}
+
+# text inputs: the tests, and the random terrains converted to text
+TEXTS="${TESTS_PATH}*.in"
+for size in $SIZES; do
+  text="${BENCH_PATH}random${size}.in"
+  [ -f "$text" ] || ./${BENCH_PATH}${MAINFILE}_PQ_BINARY -c "$text" "${BENCH_PATH}random${size}.bin" || exit 1
+  TEXTS="$TEXTS $text"
+done
+
+printf "\n%-20s %12s %12s %12s\n" "input" "fscanf" "scan" "scan SWAR"
+for input in $TEXTS; do
+  printf "%-20s" "$(basename $input)"
+  median "parse ms" ./${BENCH_PATH}${MAINFILE}_PQ_BINARY -v -e grid -p fscanf $input
+  median "parse ms" ./${BENCH_PATH}${MAINFILE}_PQ_BINARY -v -e grid -p scan $input
+  median "parse ms" ./${BENCH_PATH}${MAINFILE}_swar -v -e grid -p scan $input
+  printf "\n"
+done
+
+# text inputs the graph engine reads (up to MAX_DIMENSION rows), with the graph from the arena and with a malloc per object
+printf "\n%-20s %-8s %12s %12s %12s %12s %12s\n" "input" "graph" "allocations" "MB" "build ms" "free ms" "peak kB"
+for input in $TEXTS; do
+  [ "$(sed -n 3p $input)" -gt 250 ] && continue
+  for variant in arena malloc; do
+    binary=./${BENCH_PATH}${MAINFILE}_PQ_BINARY
+    [ $variant = malloc ] && binary=./${BENCH_PATH}${MAINFILE}_malloc
+    printf "%-20s %-8s" "$(basename $input)" $variant
+    $binary -v -e graph $input 2>&1 >/dev/null | awk '/build ms/ { printf " %12d %12.1f", $5, $8 }'
+    median "build ms" $binary -v -e graph $input
+    median "free ms" $binary -v -e graph $input
+    $binary --stats -e graph $input 2>&1 >/dev/null | awk '/peak_rss_kb/ { sub("}", "", $NF); printf " %12d", $NF }'
+    printf "\n"
+  done
+done
@@ -0,0 +1,290 @@
+/*
+Terrain generator for the benchmarks of 0001114169.c: writes a binary terrain (same format read by
+the program, see TerrainHeader) of the given kind, size and seed. Equal arguments give equal terrains.
+*/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <assert.h>
+#include <string.h>
+
+#define TERRAIN_MAGIC "ELTR" /* first bytes of a binary terrain file */
+#define TERRAIN_VERSION 1    /* version of the binary terrain format */
+
+#define C_CELL 10  /* cell movement weight of the generated terrains */
+#define C_HEIGHT 3 /* cell height difference weight of the generated terrains */
+
+#define RANDOM_HEIGHT 100  /* random: heights 0..RANDOM_HEIGHT-1 */
+#define FRACTAL_HEIGHT 999 /* fractal and plateau: heights 0..FRACTAL_HEIGHT */
+#define FRACTAL_SIDE 4097  /* largest diamond-square grid (2^12 + 1), larger terrains interpolate it */
+#define PLATEAU_STEP 250   /* plateau: fractal heights rounded down to multiples of this */
+#define MAZE_WALL 1000     /* maze: height of the walls */
+#define MAZE_FLOOR 10      /* maze: corridors heights 0..MAZE_FLOOR-1 */
+
+/*
+Header of a binary terrain file, as in 0001114169.c
+*/
+typedef struct TerrainHeader
+{
+    char magic[4]; /* TERRAIN_MAGIC */
+    int version;   /* TERRAIN_VERSION */
+    int C_cell;    /* cell movement weight */
+    int C_height;  /* cell height difference weight */
+    int n;         /* rows */
+    int m;         /* columns */
+    int width;     /* bytes of a height: 2 or 4 */
+    int reserved;  /* 0, pads the header to 32 bytes */
+} TerrainHeader;
+
+/* RANDOM */
+
+/*
+Return next pseudo-random number of `state` (xorshift64*), the same on every platform with 64 bit longs
+*/
+unsigned long next_random(unsigned long *const state)
+{
+    *state ^= *state >> 12;
+    *state ^= *state << 25;
+    *state ^= *state >> 27;
+    return (*state * 2685821657736338717UL) >> 11;
+}
+
+/*
+Return pseudo-random number of `state` in 0..`bound`-1
+*/
+int random_below(unsigned long *const state, const int bound)
+{
+    return (int)(next_random(state) % (unsigned long)bound);
+}
+
+/*
+Return pseudo-random number of `state` in [-1, 1]
+*/
+double random_unit(unsigned long *const state)
+{
+    return (double)next_random(state) / (double)(1UL << 53) * 2.0 - 1.0;
+}
+
+/* FRACTAL */
+
+/*
+Fill the `side` x `side` grid `F` (side = 2^k + 1) with diamond-square heights: corners are random,
+then every square sets its center and every diamond its center to the mean of its corners plus noise,
+halving the noise at every level
+*/
+void diamond_square(double *const F, const int side, unsigned long *const state)
+{
+    int i, j, half, step, count;
+    double noise, sum;
+
+    F[0] = random_unit(state);
+    F[side - 1] = random_unit(state);
+    F[(side - 1) * side] = random_unit(state);
+    F[side * side - 1] = random_unit(state);
+
+    noise = 1.0;
+    for (step = side - 1; step > 1; step /= 2)
+    {
+        half = step / 2;
+
+        /* squares */
+        for (i = half; i < side; i += step)
+        {
+            for (j = half; j < side; j += step)
+            {
+                sum = F[(i - half) * side + j - half] + F[(i - half) * side + j + half] +
+                      F[(i + half) * side + j - half] + F[(i + half) * side + j + half];
+                F[i * side + j] = sum / 4 + random_unit(state) * noise;
+            }
+        }
+
+        /* diamonds: the cells between two square corners, on the border with 3 corners */
+        for (i = 0; i < side; i += half)
+        {
+            for (j = (i / half) % 2 == 0 ? half : 0; j < side; j += step)
+            {
+                sum = 0;
+                count = 0;
+                if (i >= half)
+                {
+                    sum += F[(i - half) * side + j];
+                    count++;
+                }
+                if (i + half < side)
+                {
+                    sum += F[(i + half) * side + j];
+                    count++;
+                }
+                if (j >= half)
+                {
+                    sum += F[i * side + j - half];
+                    count++;
+                }
+                if (j + half < side)
+                {
+                    sum += F[i * side + j + half];
+                    count++;
+                }
+                F[i * side + j] = sum / count + random_unit(state) * noise;
+            }
+        }
+
+        noise /= 2;
+    }
+}
+
+/*
+Fill row `row` of a `n` x `m` terrain (`out`) from the diamond-square grid `F`, scaled to 0..FRACTAL_HEIGHT
+using its `low`..`high` range; if the terrain is larger than `F` it is bilinearly interpolated
+*/
+void fractal_row(const double *const F, const int side, const double low, const double high,
+                 const int n, const int m, const int row, short *const out)
+{
+    int j, i0, j0;
+    double y, x, dy, dx, value;
+
+    y = n > side ? (double)row * (side - 1) / (n - 1) : row;
+    i0 = (int)y < side - 1 ? (int)y : side - 2;
+    dy = y - i0;
+    for (j = 0; j < m; j++)
+    {
+        x = m > side ? (double)j * (side - 1) / (m - 1) : j;
+        j0 = (int)x < side - 1 ? (int)x : side - 2;
+        dx = x - j0;
+        value = F[i0 * side + j0] * (1 - dy) * (1 - dx) + F[i0 * side + j0 + 1] * (1 - dy) * dx +
+                F[(i0 + 1) * side + j0] * dy * (1 - dx) + F[(i0 + 1) * side + j0 + 1] * dy * dx;
+        out[j] = (short)((value - low) / (high - low) * FRACTAL_HEIGHT);
+    }
+}
+
+/* MAZE */
+
+/*
+Fill row `row` of a `m` columns maze (`out`, the row before it is `above`): rooms on even rows and
+columns, walls elsewhere.
+Every room opens a passage to the room above or to the one on its left (binary tree maze),
+so every room is connected to the top left one
+*/
+void maze_row(const int m, const int row, unsigned long *const state, short *const out, short *const above)
+{
+    int j;
+
+    for (j = 0; j < m; j++)
+    {
+        out[j] = MAZE_WALL;
+        if (row % 2 == 0 && j % 2 == 0)
+        {
+            out[j] = (short)random_below(state, MAZE_FLOOR);
+            if (row > 0 && (j == 0 || random_below(state, 2) == 0))
+                above[j] = (short)random_below(state, MAZE_FLOOR); /* open up */
+            else if (j > 0)
+                out[j - 1] = (short)random_below(state, MAZE_FLOOR); /* open left */
+        }
+    }
+}
+
+/* MAIN */
+
+int main(int argc, char *argv[])
+{
+    TerrainHeader header;
+    FILE *fileout;
+    short *rows;
+    double *F = NULL;
+    double low, high;
+    unsigned long state;
+    int i, j, n, m, side, kind;
+    const char *kinds[] = {"random", "fractal", "maze", "plateau"};
+
+    if (argc != 6 || atoi(argv[2]) < 2 || atoi(argv[3]) < 2)
+    {
+        fprintf(stderr, "Invocare il programma con: %s random|fractal|maze|plateau rows columns seed output_file\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+    for (kind = 0; kind < 4 && strcmp(argv[1], kinds[kind]) != 0; kind++)
+        ;
+    if (kind == 4)
+    {
+        fprintf(stderr, "Unknown terrain %s\n", argv[1]);
+        return EXIT_FAILURE;
+    }
+    n = atoi(argv[2]);
+    m = atoi(argv[3]);
+    state = 0x9E3779B97F4A7C15UL ^ strtoul(argv[4], NULL, 10); /* spread the bits of small seeds */
+    if (state == 0) /* xorshift never leaves 0 */
+        state = 1;
+
+    fileout = fopen(argv[5], "wb");
+    if (fileout == NULL)
+    {
+        fprintf(stderr, "Can not write %s\n", argv[5]);
+        return EXIT_FAILURE;
+    }
+
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, TERRAIN_MAGIC, sizeof(header.magic));
+    header.version = TERRAIN_VERSION;
+    header.C_cell = C_CELL;
+    header.C_height = C_HEIGHT;
+    header.n = n;
+    header.m = m;
+    header.width = 2;
+    fwrite(&header, sizeof(header), 1, fileout);
+
+    /* fractal and plateau: one diamond-square grid, large enough for the terrain or FRACTAL_SIDE */
+    side = 0;
+    low = high = 0;
+    if (kind == 1 || kind == 3)
+    {
+        for (side = 3; side < FRACTAL_SIDE && (side < n || side < m); side = (side - 1) * 2 + 1)
+            ;
+        F = (double *)calloc((size_t)side * side, sizeof(double));
+        assert(F != NULL);
+        diamond_square(F, side, &state);
+        low = high = F[0];
+        for (i = 0; i < side * side; i++)
+        {
+            low = F[i] < low ? F[i] : low;
+            high = F[i] > high ? F[i] : high;
+        }
+        high = high > low ? high : low + 1;
+    }
+
+    /* rows are written one by one, the maze keeps the previous one to open passages up */
+    rows = (short *)calloc(2 * (size_t)m, sizeof(short));
+    assert(rows != NULL);
+    for (i = 0; i < n; i++)
+    {
+        if (kind == 0)
+        {
+            for (j = 0; j < m; j++)
+                rows[m + j] = (short)random_below(&state, RANDOM_HEIGHT);
+        }
+        else if (kind == 2)
+        {
+            maze_row(m, i, &state, rows + m, rows);
+        }
+        else
+        {
+            fractal_row(F, side, low, high, n, m, i, rows + m);
+            for (j = 0; kind == 3 && j < m; j++)
+                rows[m + j] = rows[m + j] / PLATEAU_STEP * PLATEAU_STEP;
+        }
+
+        if (i > 0)
+            fwrite(rows, sizeof(short), m, fileout);
+        memcpy(rows, rows + m, m * sizeof(short));
+    }
+    fwrite(rows, sizeof(short), m, fileout);
+
+    free(rows);
+    free(F);
+
+    if (fclose(fileout) != 0)
+    {
+        fprintf(stderr, "Can not write %s\n", argv[5]);
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -4,7 +4,7 @@ TESTS_PATH="test/"
 RESULTS_PATH="results/"
 
 MAINFILE="0001114169"
-COMPILE="gcc -std=c90 -Wall -Wpedantic ${MAINFILE}.c -o ${MAINFILE}"
+COMPILE="gcc -std=c90 -Wall -Wpedantic ${MAINFILE}.c -o ${MAINFILE} -pthread"
 
 TEST_START=$1
 TEST_END=$2